@@ -101,6 +101,35 @@ void print_hosts_info(hostInfoVec* hosts, std::mutex* mtx){
    print_hosts_info(hosts, mtx);
 }
 
+/*
+ * Функция read_dump_commands() читает команды из стандартного ввода в отдельном потоке.
+ * Команда "dump <hostname> <seconds> <file>" сохраняет в pcap файл пакеты хоста за последние seconds секунд
+ * из кольца захвата. Имя хоста указывается в том же виде, в котором оно выводится в статистике.
+ * Если часть пакетов не попала в кольцо, после дампа выводится их количество.
+*/
+void read_dump_commands(captureRing* ring){
+   std::string line;
+   while (std::getline(std::cin, line)){
+      std::istringstream iss(line);
+      std::string command, hostname, out_path;
+      int seconds;
+      if (!(iss >> command >> hostname >> seconds >> out_path) || command != "dump"){
+         std::cout << "Usage: dump <hostname> <seconds> <file>" << std::endl;
+         continue;
+      }
+
+      auto res = ring->dump(hostname, seconds, out_path);
+      if (res != RING_RESULT_TYPE::SUCCESS)
+         std::cout << "Cannot dump packets to " << out_path << std::endl;
+      else
+         std::cout << "Packets of " << hostname << " saved to " << out_path << std::endl;
+
+      uint64_t dropped = ring->get_dropped_count();
+      if (dropped != 0)
+         std::cout << "Warning: " << dropped << " packets were dropped from ring, dump may be incomplete" << std::endl;
+   }
+}
+
 /*
  * Функция my_packet_handler является хэндлером для функции pcap_loop, предназначенной для захвата сетевых пакетов.
  * Она выполняет обработку захваченных пакетов, анализирует их содержимое.
@@ -132,6 +161,7 @@ void my_packet_handler(u_char *args, const struct pcap_pkthdr* header, const u_c
    const ether_addr* dst_mac = reinterpret_cast<const ether_addr*>(eth_header->ether_dhost);
 
    uint32_t packet_size = header->len;
+   std::string captured_host;
    std::unique_lock<std::mutex> lock(mtx);
    
    if (std::memcmp(dst_mac, if_mac, sizeof(ether_addr)) == 0){
@@ -151,6 +181,7 @@ void my_packet_handler(u_char *args, const struct pcap_pkthdr* header, const u_c
       spdlog::get("packet_logger")->info("Packet source name - {}", cur_host.get_hostname());
 
       cur_host.make_hostname_pretty();
+      captured_host = cur_host.get_hostname();
 
       // Поиск хоста в общем списке хостов и обновление данных о размере трафика и кол-ве пакетов
       auto it = std::find(hosts->begin(), hosts->end(), cur_host);
@@ -180,6 +211,7 @@ void my_packet_handler(u_char *args, const struct pcap_pkthdr* header, const u_c
       spdlog::get("packet_logger")->info("Packet destination name - {}", cur_host.get_hostname());
 
       cur_host.make_hostname_pretty();
+      captured_host = cur_host.get_hostname();
 
       // Поиск хоста в общем списке хостов и обновление данных о размере трафика и кол-ве пакетов
       auto it = std::find(hosts->begin(), hosts->end(), cur_host);
@@ -195,4 +227,8 @@ void my_packet_handler(u_char *args, const struct pcap_pkthdr* header, const u_c
       spdlog::get("packet_logger")->critical("Unknown package recieved... Skipping");
 
    lock.unlock();
+
+   // Сохранение пакета в кольцо на диске, если оно включено
+   if (h_args->ring != nullptr && !captured_host.empty())
+      h_args->ring->push(header, packet, captured_host);
 }
\ No newline at end of file
@@ -1,17 +1,21 @@
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <spdlog/sinks/rotating_file_sink.h>
 #include "hostInfo.h"
+#include "captureRing.h"
 
 struct handler_args{
-   explicit handler_args(hostInfoVec* hosts, ether_addr* if_mac, std::mutex* mtx) : 
+   explicit handler_args(hostInfoVec* hosts, ether_addr* if_mac, std::mutex* mtx, captureRing* ring = nullptr) : 
       hosts(hosts),
       if_mac(if_mac),
-      mtx(mtx) {}
+      mtx(mtx),
+      ring(ring) {}
 
    hostInfoVec* hosts;
    ether_addr* if_mac;
    std::mutex* mtx;
+   captureRing* ring;
 };
 
 void setup_logger();
@@ -20,4 +24,5 @@ bool isConvertKBtoMB(int size);
 double calculate_output_size(int size, int f);
 
 void print_hosts_info(hostInfoVec* hosts, std::mutex* mtx);
+void read_dump_commands(captureRing* ring);
 void my_packet_handler(u_char *args, const struct pcap_pkthdr* header, const u_char *packet);
\ No newline at end of file
@@ -0,0 +1,438 @@
+#include "captureRing.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+/*
+ * Вспомогательные функции: выравнивание размера записи до кратного align
+ * и получение ключа хоста, по которому строится индекс кольца.
+*/
+static size_t align_up(size_t size, size_t align){
+    return (size + align - 1) / align * align;
+}
+
+static uint64_t make_host_key(const std::string& hostname){
+    return std::hash<std::string>{}(hostname);
+}
+
+/*
+ * Конструктор класса captureRing.
+ * Принимает путь к файлу кольца и количество слотов (блоков по BLOCK_SIZE байт) в нем.
+ * Сам файл открывается и размечается в методе setup().
+*/
+captureRing::captureRing(std::string path, size_t slots_count) :
+    path(std::move(path)),
+    slots_count(slots_count),
+    fd(-1),
+    next_seq(0),
+    stopping(false),
+    dropped(0) {}
+
+/*
+ * Функция setup() открывает файл кольца с флагом O_DIRECT, чтобы большие последовательные записи
+ * шли мимо page cache. Если файловая система не поддерживает O_DIRECT (например, tmpfs),
+ * файл открывается в обычном режиме. Затем под кольцо резервируется место на диске (posix_fallocate),
+ * выделяются выровненные буферы для блоков и запускается поток записи.
+ * Возвращает результат настройки в виде перечисления RING_RESULT_TYPE.
+*/
+RING_RESULT_TYPE captureRing::setup(){
+    spdlog::get("packet_logger")->debug("Setup capture ring func entered");
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+    if (fd == -1 && errno == EINVAL){
+        spdlog::get("packet_logger")->warn("O_DIRECT is not supported for {}, using buffered io", path);
+        fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    }
+    if (fd == -1){
+        spdlog::get("packet_logger")->error("Cannot open capture ring file {}", path);
+        return RING_RESULT_TYPE::OPEN_FILE_ERROR;
+    }
+
+    // posix_fallocate возвращает код ошибки, а не -1. Без его поддержки файл остается разреженным.
+    off_t ring_size = slots_count * BLOCK_SIZE;
+    if (ftruncate(fd, ring_size) == -1){
+        spdlog::get("packet_logger")->error("Cannot allocate {} slots for capture ring", slots_count);
+        return RING_RESULT_TYPE::ALLOCATE_FILE_ERROR;
+    }
+    int res = posix_fallocate(fd, 0, ring_size);
+    if (res == EOPNOTSUPP || res == EINVAL){
+        spdlog::get("packet_logger")->warn("Cannot reserve disk space for {}, ring file stays sparse", path);
+    }
+    else if (res != 0){
+        spdlog::get("packet_logger")->error("Cannot allocate {} slots for capture ring", slots_count);
+        return RING_RESULT_TYPE::ALLOCATE_FILE_ERROR;
+    }
+
+    slots.resize(slots_count);
+    for (size_t i = 0; i < STAGING_BLOCKS; ++i){
+        u_char* buffer = static_cast<u_char*>(std::aligned_alloc(IO_ALIGN, BLOCK_SIZE));
+        if (buffer == nullptr){
+            spdlog::get("packet_logger")->error("Cannot allocate capture ring buffers");
+            return RING_RESULT_TYPE::ALLOCATE_BUFFER_ERROR;
+        }
+        free_buffers.push_back(buffer);
+    }
+
+    current.data = free_buffers.back();
+    free_buffers.pop_back();
+
+    writer = std::thread(&captureRing::writer_loop, this);
+
+    spdlog::get("packet_logger")->debug("Setup capture ring func successfully ended");
+
+    return RING_RESULT_TYPE::SUCCESS;
+}
+
+/*
+ * Функция push() вызывается из хэндлера pcap_loop и только копирует пакет в текущий блок в памяти.
+ * Заполненный блок передается потоку записи. Если все буферы заняты ожидающими записи блоками,
+ * пакет отбрасывается и учитывается в счетчике dropped - диск никогда не тормозит захват.
+*/
+void captureRing::push(const pcap_pkthdr* header, const u_char* packet, const std::string& hostname){
+    uint32_t caplen = std::min<size_t>(header->caplen, BLOCK_SIZE - sizeof(ring_record_header));
+    size_t record_size = align_up(sizeof(ring_record_header) + caplen, alignof(ring_record_header));
+    uint64_t host_key = make_host_key(hostname);
+
+    std::unique_lock<std::mutex> lock(staging_mtx);
+
+    if (current.data != nullptr && current.used + record_size > BLOCK_SIZE)
+        seal_current();
+
+    if (current.data == nullptr){
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ring_record_header record;
+    record.ts_sec = header->ts.tv_sec;
+    record.ts_usec = header->ts.tv_usec;
+    record.caplen = caplen;
+    record.len = header->len;
+    record.host_key = host_key;
+
+    std::memcpy(current.data + current.used, &record, sizeof(record));
+    std::memcpy(current.data + current.used + sizeof(record), packet, caplen);
+
+    if (current.used == 0)
+        current.index.first_ts = header->ts;
+    current.index.last_ts = header->ts;
+    current.index.hosts.insert(host_key);
+    current.used += record_size;
+}
+
+/*
+ * Функция seal_current() передает текущий блок в очередь на запись и берет свободный буфер.
+ * Если свободных буферов нет, текущий блок остается пустым до возврата буфера потоком записи.
+ * Вызывается под staging_mtx.
+*/
+void captureRing::seal_current(){
+    if (current.used == 0)
+        return;
+
+    current.index.seq = next_seq++;
+    current.index.used = current.used;
+    full_blocks.push_back(std::move(current));
+    current = ring_block{};
+
+    if (!free_buffers.empty()){
+        current.data = free_buffers.back();
+        free_buffers.pop_back();
+    }
+
+    staging_cv.notify_one();
+}
+
+/*
+ * Функция flush() передает текущий блок на запись и ждет, пока поток записи
+ * сохранит на диск все накопленные блоки.
+*/
+void captureRing::flush(){
+    std::unique_lock<std::mutex> lock(staging_mtx);
+    seal_current();
+    drained_cv.wait(lock, [this]{ return full_blocks.empty(); });
+}
+
+/*
+ * Функция writer_loop() выполняется в отдельном потоке и записывает заполненные блоки в кольцо
+ * одной последовательной записью на блок. Перед записью слот убирается из индекса, чтобы запрос
+ * не прочитал наполовину перезаписанные данные, после записи индекс слота публикуется заново.
+ * Блок удаляется из очереди только после публикации, поэтому запрос всегда видит его
+ * либо в памяти, либо на диске.
+*/
+void captureRing::writer_loop(){
+    spdlog::get("packet_logger")->debug("Capture ring writer started");
+
+    while (true){
+        std::unique_lock<std::mutex> lock(staging_mtx);
+        staging_cv.wait(lock, [this]{ return stopping || !full_blocks.empty(); });
+        if (full_blocks.empty())
+            break;
+
+        // Ссылки на элементы deque остаются валидными при push_back из push()
+        ring_block& block = full_blocks.front();
+        lock.unlock();
+
+        // Старые записи индекса освобождаются вне блокировок, чтобы не держать их дольше обмена
+        size_t slot = block.index.seq % slots_count;
+        ring_slot_index retired;
+        {
+            std::unique_lock<std::mutex> index_lock(index_mtx);
+            std::swap(retired, slots[slot]);
+        }
+
+        size_t size = align_up(block.used, IO_ALIGN);
+        off_t offset = slot * BLOCK_SIZE;
+        size_t written = 0;
+        while (written < size){
+            ssize_t n = pwrite(fd, block.data + written, size - written, offset + written);
+            if (n <= 0){
+                spdlog::get("packet_logger")->error("Cannot write capture ring slot {}", slot);
+                break;
+            }
+            written += n;
+        }
+
+        // Индекс блока копируется: dump() может читать его из очереди под staging_mtx.
+        // Публикация идет только под index_mtx, чтобы push() не ждал сканирования индекса в dump().
+        // Пока блок одновременно опубликован и в очереди, dump() отсекает его по memory_seqs.
+        if (written == size){
+            ring_slot_index published = block.index;
+            std::unique_lock<std::mutex> index_lock(index_mtx);
+            std::swap(slots[slot], published);
+        }
+
+        lock.lock();
+        release_buffer(block.data);
+        ring_slot_index finished = std::move(block.index);
+        full_blocks.pop_front();
+        if (full_blocks.empty())
+            drained_cv.notify_all();
+        lock.unlock();
+    }
+
+    spdlog::get("packet_logger")->debug("Capture ring writer stopped");
+}
+
+/*
+ * Функция release_buffer() возвращает записанный буфер в пул. Если буфер в этот момент читает dump(),
+ * возврат откладывается до вызова unpin_buffer(). Обе функции вызываются под staging_mtx.
+*/
+void captureRing::release_buffer(u_char* buffer){
+    if (pinned_buffers.count(buffer) != 0){
+        released_buffers.insert(buffer);
+        return;
+    }
+
+    if (current.data == nullptr)
+        current.data = buffer;
+    else
+        free_buffers.push_back(buffer);
+}
+
+void captureRing::unpin_buffer(u_char* buffer){
+    if (--pinned_buffers[buffer] != 0)
+        return;
+
+    pinned_buffers.erase(buffer);
+    if (released_buffers.erase(buffer) != 0)
+        release_buffer(buffer);
+}
+
+/*
+ * Функция collect_records() копирует в out записи нужного хоста, захваченные не раньше момента since,
+ * в том же формате, что и в блоке, чтобы потом передать их в dump_records().
+*/
+void captureRing::collect_records(const u_char* data, uint32_t used, uint64_t host_key, const timeval& since, std::vector<u_char>& out){
+    size_t pos = 0;
+    while (pos + sizeof(ring_record_header) <= used){
+        ring_record_header record;
+        std::memcpy(&record, data + pos, sizeof(record));
+
+        size_t record_size = align_up(sizeof(record) + record.caplen, alignof(ring_record_header));
+        timeval ts;
+        ts.tv_sec = record.ts_sec;
+        ts.tv_usec = record.ts_usec;
+        if (record.host_key == host_key && !timercmp(&ts, &since, <))
+            out.insert(out.end(), data + pos, data + pos + record_size);
+
+        pos += record_size;
+    }
+}
+
+/*
+ * Функция dump_records() записывает в pcap файл пакеты нужного хоста из блока записей,
+ * захваченные не раньше момента since. Возвращает количество записанных пакетов.
+*/
+size_t captureRing::dump_records(pcap_dumper_t* dumper, const u_char* data, size_t used, uint64_t host_key, const timeval& since){
+    size_t count = 0;
+    size_t pos = 0;
+    while (pos + sizeof(ring_record_header) <= used){
+        ring_record_header record;
+        std::memcpy(&record, data + pos, sizeof(record));
+
+        pcap_pkthdr header;
+        header.ts.tv_sec = record.ts_sec;
+        header.ts.tv_usec = record.ts_usec;
+        header.caplen = record.caplen;
+        header.len = record.len;
+        if (record.host_key == host_key && !timercmp(&header.ts, &since, <)){
+            pcap_dump(reinterpret_cast<u_char*>(dumper), &header, data + pos + sizeof(record));
+            ++count;
+        }
+
+        pos += align_up(sizeof(record) + record.caplen, alignof(ring_record_header));
+    }
+    return count;
+}
+
+/*
+ * Функция dump() сохраняет в pcap файл out_path пакеты хоста hostname за последние last_seconds секунд.
+ * Сначала просматриваются блоки, еще не записанные на диск, затем по индексу выбираются только те слоты
+ * кольца, временной диапазон и набор хостов которых подходят под запрос - остальное кольцо не читается.
+ * Пакеты слота пишутся в файл сразу после его чтения, в памяти копируются только подходящие записи
+ * еще не записанных на диск блоков.
+ * Возвращает результат в виде перечисления RING_RESULT_TYPE.
+*/
+RING_RESULT_TYPE captureRing::dump(const std::string& hostname, int last_seconds, const std::string& out_path){
+    spdlog::get("packet_logger")->debug("Capture ring dump func entered");
+
+    uint64_t host_key = make_host_key(hostname);
+    timeval now, window{last_seconds, 0}, since;
+    gettimeofday(&now, NULL);
+    timersub(&now, &window, &since);
+
+    pcap_t* dead = pcap_open_dead(DLT_EN10MB, BUFSIZ);
+    pcap_dumper_t* dumper = pcap_dump_open(dead, out_path.c_str());
+    if (dumper == NULL){
+        spdlog::get("packet_logger")->error("Cannot open dump file {}", out_path);
+        pcap_close(dead);
+        return RING_RESULT_TYPE::OPEN_DUMP_ERROR;
+    }
+
+    auto is_match = [&](const ring_slot_index& index, uint32_t used){
+        return used != 0 && !timercmp(&index.last_ts, &since, <) && index.hosts.count(host_key) != 0;
+    };
+
+    // Блоки в памяти: очередь на запись и текущий блок. Под staging_mtx подходящие буферы только
+    // закрепляются, разбор идет без блокировки, чтобы не задерживать push() из pcap_loop.
+    // Записи текущего блока до снятого used не меняются - push() дописывает только после них.
+    std::vector<std::pair<u_char*, uint32_t>> memory_blocks;
+    std::unordered_set<uint64_t> memory_seqs;
+    uint64_t snapshot_seq;
+    {
+        std::unique_lock<std::mutex> lock(staging_mtx);
+        for (auto& block: full_blocks){
+            memory_seqs.insert(block.index.seq);
+            if (is_match(block.index, block.used))
+                memory_blocks.emplace_back(block.data, block.used);
+        }
+        // Текущий блок получит номер next_seq при передаче на запись
+        memory_seqs.insert(next_seq);
+        snapshot_seq = next_seq;
+        if (is_match(current.index, current.used))
+            memory_blocks.emplace_back(current.data, current.used);
+
+        for (auto& [data, used]: memory_blocks)
+            ++pinned_buffers[data];
+    }
+
+    std::vector<u_char> memory_records;
+    for (auto& [data, used]: memory_blocks)
+        collect_records(data, used, host_key, since, memory_records);
+
+    {
+        std::unique_lock<std::mutex> lock(staging_mtx);
+        for (auto& [data, used]: memory_blocks)
+            unpin_buffer(data);
+    }
+
+    // Слоты на диске, подходящие по индексу, в порядке записи. Блоки, переданные на запись
+    // после снимка памяти, новее запроса и пропускаются, чтобы не нарушить порядок пакетов.
+    std::vector<std::pair<uint64_t, uint32_t>> candidates;
+    {
+        std::unique_lock<std::mutex> index_lock(index_mtx);
+        for (auto& index: slots){
+            if (is_match(index, index.used) && index.seq < snapshot_seq && memory_seqs.count(index.seq) == 0)
+                candidates.emplace_back(index.seq, index.used);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    // Слоты с диска сразу пишутся в файл, затем более новые записи из памяти
+    size_t dumped = 0;
+    u_char* buffer = static_cast<u_char*>(std::aligned_alloc(IO_ALIGN, BLOCK_SIZE));
+    if (buffer == nullptr){
+        spdlog::get("packet_logger")->error("Cannot allocate capture ring read buffer");
+        pcap_dump_close(dumper);
+        pcap_close(dead);
+        return RING_RESULT_TYPE::ALLOCATE_BUFFER_ERROR;
+    }
+    for (auto& [seq, used]: candidates){
+        size_t slot = seq % slots_count;
+        size_t size = align_up(used, IO_ALIGN);
+        if (pread(fd, buffer, size, slot * BLOCK_SIZE) != static_cast<ssize_t>(size)){
+            spdlog::get("packet_logger")->error("Cannot read capture ring slot {}", slot);
+            continue;
+        }
+
+        // Слот мог быть перезаписан во время чтения - тогда его данные старше окна запроса
+        std::unique_lock<std::mutex> index_lock(index_mtx);
+        if (slots[slot].seq != seq || slots[slot].used == 0)
+            continue;
+        index_lock.unlock();
+
+        dumped += dump_records(dumper, buffer, used, host_key, since);
+    }
+    std::free(buffer);
+
+    dumped += dump_records(dumper, memory_records.data(), memory_records.size(), host_key, since);
+
+    pcap_dump_close(dumper);
+    pcap_close(dead);
+
+    spdlog::get("packet_logger")->info(
+        "Dumped {} packets of {} for last {} sec to {} ({} packets dropped from ring so far)",
+        dumped,
+        hostname,
+        last_seconds,
+        out_path,
+        get_dropped_count()
+    );
+
+    return RING_RESULT_TYPE::SUCCESS;
+}
+
+// Геттер get_dropped_count() возвращает количество пакетов, не попавших в кольцо из-за занятых буферов.
+uint64_t captureRing::get_dropped_count() const{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+/*
+ * Деструктор останавливает поток записи, предварительно дописав в кольцо все накопленные блоки,
+ * и освобождает буферы и файловый дескриптор.
+*/
+captureRing::~captureRing(){
+    if (writer.joinable()){
+        {
+            std::unique_lock<std::mutex> lock(staging_mtx);
+            seal_current();
+            stopping = true;
+        }
+        staging_cv.notify_one();
+        writer.join();
+    }
+
+    std::free(current.data);
+    for (auto* buffer: free_buffers)
+        std::free(buffer);
+
+    if (fd != -1){
+        close(fd);
+        fd = -1;
+    }
+}
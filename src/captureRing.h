@@ -0,0 +1,98 @@
+#include <pcap.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_set>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <spdlog/spdlog.h>
+
+
+enum class RING_RESULT_TYPE{
+   SUCCESS,
+   OPEN_FILE_ERROR,
+   ALLOCATE_FILE_ERROR,
+   ALLOCATE_BUFFER_ERROR,
+   OPEN_DUMP_ERROR,
+};
+
+// Заголовок одной записи пакета внутри блока кольца
+struct ring_record_header{
+   int64_t ts_sec;
+   int64_t ts_usec;
+   uint32_t caplen;
+   uint32_t len;
+   uint64_t host_key;
+};
+
+// Индекс одного слота кольца на диске: временной диапазон и набор хостов внутри блока
+struct ring_slot_index{
+   uint64_t seq = 0;
+   uint32_t used = 0;
+   timeval first_ts{};
+   timeval last_ts{};
+   std::unordered_set<uint64_t> hosts;
+};
+
+// Блок в памяти, накапливающий записи перед одной большой записью на диск
+struct ring_block{
+   u_char* data = nullptr;
+   uint32_t used = 0;
+   ring_slot_index index;
+};
+
+class captureRing{
+public:
+   static constexpr size_t BLOCK_SIZE = 1 << 20;
+   static constexpr size_t IO_ALIGN = 4096;
+   static constexpr size_t STAGING_BLOCKS = 8;
+
+   explicit captureRing(std::string path, size_t slots_count);
+   ~captureRing();
+
+   RING_RESULT_TYPE setup();
+
+   void push(const pcap_pkthdr* header, const u_char* packet, const std::string& hostname);
+   RING_RESULT_TYPE dump(const std::string& hostname, int last_seconds, const std::string& out_path);
+   void flush();
+
+   uint64_t get_dropped_count() const;
+
+private:
+   void writer_loop();
+   void seal_current();
+   void release_buffer(u_char* buffer);
+   void unpin_buffer(u_char* buffer);
+   void collect_records(const u_char* data, uint32_t used, uint64_t host_key, const timeval& since, std::vector<u_char>& out);
+   size_t dump_records(pcap_dumper_t* dumper, const u_char* data, size_t used, uint64_t host_key, const timeval& since);
+
+   std::string path;
+   size_t slots_count;
+   int fd;
+
+   // Данные со стороны pcap_loop, защищены staging_mtx
+   std::mutex staging_mtx;
+   std::condition_variable staging_cv;
+   std::condition_variable drained_cv;
+   std::vector<u_char*> free_buffers;
+   std::deque<ring_block> full_blocks;
+   ring_block current;
+   uint64_t next_seq;
+   bool stopping;
+
+   // Буферы, которые читает dump() без staging_mtx, и ожидающие их освобождения
+   std::unordered_map<u_char*, int> pinned_buffers;
+   std::unordered_set<u_char*> released_buffers;
+
+   // Индекс записанных на диск слотов, защищен index_mtx
+   std::mutex index_mtx;
+   std::vector<ring_slot_index> slots;
+
+   std::atomic<uint64_t> dropped;
+   std::thread writer;
+};
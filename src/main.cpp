@@ -1,7 +1,12 @@
 #include "ethDevice.h"
 #include "additional.h"
 
-int main(){
+/*
+ * Запуск: ./traffic_sniffer [ring_file [ring_size_MB]]
+ * Если указан ring_file, пакеты дополнительно сохраняются в кольцо на диске
+ * размером ring_size_MB (по умолчанию 256 МБ), а из стандартного ввода принимаются команды dump.
+*/
+int main(int argc, char** argv){
    setup_logger();
 
    ethDevice dev;
@@ -9,12 +14,31 @@ int main(){
    if (res != SETUP_RESULT_TYPE::SUCCESS)
       return 2;
 
+   std::unique_ptr<captureRing> ring;
+   if (argc > 1){
+      size_t ring_size_mb = 256;
+      if (argc > 2){
+         char* end;
+         errno = 0;
+         ring_size_mb = std::strtoul(argv[2], &end, 10);
+         bool is_invalid = errno != 0 || end == argv[2] || *end != '\0' || argv[2][0] == '-';
+         if (is_invalid || ring_size_mb == 0 || ring_size_mb > (SIZE_MAX >> 20)){
+            std::cout << "Usage: traffic_sniffer [ring_file [ring_size_MB]]" << std::endl;
+            return 3;
+         }
+      }
+      // Размер блока кольца - 1 МБ, поэтому количество слотов равно размеру в МБ
+      ring = std::make_unique<captureRing>(argv[1], ring_size_mb);
+      if (ring->setup() != RING_RESULT_TYPE::SUCCESS)
+         return 3;
+   }
+
 
    hostInfoVec hosts;
    std::mutex mtx;
    ether_addr if_mac = dev.get_if_mac();
 
-   handler_args args(&hosts, &if_mac, &mtx);
+   handler_args args(&hosts, &if_mac, &mtx, ring.get());
 
    std::thread thr(
       pcap_loop, 
@@ -28,7 +52,12 @@ int main(){
       &hosts, 
       &mtx
    );
+   std::thread thr3;
+   if (ring)
+      thr3 = std::thread(read_dump_commands, ring.get());
 
    thr.join();
    thr2.join();
+   if (thr3.joinable())
+      thr3.join();
 }
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include "../src/additional.h"
 #include "../src/ethDevice.h"
+#include <spdlog/sinks/null_sink.h>
 
 TEST(ConvertingNeedTestSet, BELOW08) { 
     EXPECT_FALSE(isConvertKBtoMB(815));
@@ -73,6 +74,164 @@ TEST_F(HostInfoTest, TestInsertHostDataOutgoingPack) {
     EXPECT_EQ(host->get_total_package_size(), 2.0);
 }
 
+
+class CaptureRingTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        if (spdlog::get("packet_logger") == nullptr)
+            spdlog::null_logger_mt("packet_logger");
+
+        ring = std::make_unique<captureRing>(ring_path, 16);
+        ASSERT_EQ(ring->setup(), RING_RESULT_TYPE::SUCCESS);
+    }
+
+    void TearDown() override {
+        ring.reset();
+        std::remove(ring_path);
+        std::remove(dump_path);
+    }
+
+    void push_packets(const std::string& hostname, int count, int seconds_ago) {
+        std::vector<u_char> packet(1000, static_cast<u_char>(hostname.size()));
+        pcap_pkthdr header;
+        gettimeofday(&header.ts, NULL);
+        header.ts.tv_sec -= seconds_ago;
+        header.caplen = packet.size();
+        header.len = packet.size();
+        for (int i = 0; i < count; ++i)
+            ring->push(&header, packet.data(), hostname);
+    }
+
+    int count_dumped_packets() {
+        char errbuf[PCAP_ERRBUF_SIZE];
+        pcap_t* dump = pcap_open_offline(dump_path, errbuf);
+        if (dump == NULL)
+            return -1;
+
+        int count = 0;
+        pcap_pkthdr* header;
+        const u_char* data;
+        while (pcap_next_ex(dump, &header, &data) == 1){
+            EXPECT_EQ(header->caplen, 1000);
+            ++count;
+        }
+        pcap_close(dump);
+        return count;
+    }
+
+    int count_duplicate_packets() {
+        char errbuf[PCAP_ERRBUF_SIZE];
+        pcap_t* dump = pcap_open_offline(dump_path, errbuf);
+        if (dump == NULL)
+            return -1;
+
+        // Первые 8 байт каждого пакета - его уникальный номер
+        std::unordered_set<uint64_t> ids;
+        int duplicates = 0;
+        pcap_pkthdr* header;
+        const u_char* data;
+        while (pcap_next_ex(dump, &header, &data) == 1){
+            uint64_t id;
+            std::memcpy(&id, data, sizeof(id));
+            if (!ids.insert(id).second)
+                ++duplicates;
+        }
+        pcap_close(dump);
+        return duplicates;
+    }
+
+    int count_out_of_order_packets() {
+        char errbuf[PCAP_ERRBUF_SIZE];
+        pcap_t* dump = pcap_open_offline(dump_path, errbuf);
+        if (dump == NULL)
+            return -1;
+
+        // Номера пакетов в дампе должны только возрастать
+        int out_of_order = 0;
+        bool first = true;
+        uint64_t prev_id = 0;
+        pcap_pkthdr* header;
+        const u_char* data;
+        while (pcap_next_ex(dump, &header, &data) == 1){
+            uint64_t id;
+            std::memcpy(&id, data, sizeof(id));
+            if (!first && id <= prev_id)
+                ++out_of_order;
+            first = false;
+            prev_id = id;
+        }
+        pcap_close(dump);
+        return out_of_order;
+    }
+
+    const char* ring_path = "capture_ring_test.bin";
+    const char* dump_path = "capture_ring_test.pcap";
+    std::unique_ptr<captureRing> ring;
+};
+
+TEST_F(CaptureRingTest, DumpOnlyRequestedHost) {
+    push_packets("google.com", 10, 0);
+    push_packets("yandex.ru", 5, 0);
+
+    ASSERT_EQ(ring->dump("yandex.ru", 10, dump_path), RING_RESULT_TYPE::SUCCESS);
+    EXPECT_EQ(count_dumped_packets(), 5);
+}
+
+TEST_F(CaptureRingTest, DumpOnlyRequestedWindow) {
+    push_packets("google.com", 7, 60);
+    push_packets("google.com", 3, 0);
+
+    ASSERT_EQ(ring->dump("google.com", 10, dump_path), RING_RESULT_TYPE::SUCCESS);
+    EXPECT_EQ(count_dumped_packets(), 3);
+}
+
+TEST_F(CaptureRingTest, DumpBlocksWrittenToDisk) {
+    // ~6 МБ пакетов, после flush() все блоки читаются только с диска по индексу
+    push_packets("google.com", 3000, 0);
+    push_packets("yandex.ru", 3000, 0);
+    ring->flush();
+
+    ASSERT_EQ(ring->dump("google.com", 10, dump_path), RING_RESULT_TYPE::SUCCESS);
+    EXPECT_EQ(count_dumped_packets(), 3000);
+    EXPECT_EQ(ring->get_dropped_count(), 0);
+}
+
+TEST_F(CaptureRingTest, DumpWhilePushingHasNoDuplicates) {
+    // Маленькое кольцо, чтобы блоки часто уходили на диск между чтением памяти и индекса
+    ring.reset();
+    ring = std::make_unique<captureRing>(ring_path, 2);
+    ASSERT_EQ(ring->setup(), RING_RESULT_TYPE::SUCCESS);
+
+    std::atomic<bool> done(false);
+    std::thread pusher([&]{
+        std::vector<u_char> packet(1000, 0);
+        pcap_pkthdr header;
+        header.caplen = packet.size();
+        header.len = packet.size();
+        for (uint64_t id = 0; !done; ++id){
+            std::memcpy(packet.data(), &id, sizeof(id));
+            gettimeofday(&header.ts, NULL);
+            ring->push(&header, packet.data(), "google.com");
+        }
+    });
+
+    for (int i = 0; i < 200; ++i){
+        EXPECT_EQ(ring->dump("google.com", 10, dump_path), RING_RESULT_TYPE::SUCCESS);
+        EXPECT_EQ(count_duplicate_packets(), 0);
+        EXPECT_EQ(count_out_of_order_packets(), 0);
+    }
+
+    done = true;
+    pusher.join();
+}
+
+TEST_F(CaptureRingTest, DumpUnknownHost) {
+    push_packets("google.com", 10, 0);
+
+    ASSERT_EQ(ring->dump("yandex.ru", 10, dump_path), RING_RESULT_TYPE::SUCCESS);
+    EXPECT_EQ(count_dumped_packets(), 0);
+}
+
  
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);